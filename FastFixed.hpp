@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
 template <size_t N, size_t K>
 class Fixed;
 
@@ -23,7 +28,7 @@ struct SelectFastIntType {
 
 template <size_t N, size_t K>
 class FastFixed {
-    using Type = typename SelectFastIntType<N>::type;
+    using Type = typename SelectFastIntType<N>::Type;
     Type v_;
 
 public:
@@ -63,13 +68,13 @@ public:
     template <size_t N1, size_t K1>
     auto operator<(const FastFixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ < other1.v;
+        return v_ < other1.v_;
     };
 
     template <size_t N1, size_t K1>
     auto operator<=(const FastFixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ <= other1.v;
+        return v_ <= other1.v_;
     };
 
     template <size_t N1, size_t K1>
@@ -81,25 +86,25 @@ public:
     template <size_t N1, size_t K1>
     auto operator>(const FastFixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ > other1.v;
+        return v_ > other1.v_;
     };
 
     template <size_t N1, size_t K1>
     auto operator>=(const FastFixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ >= other1.v;
+        return v_ >= other1.v_;
     };
 
     template <size_t N1, size_t K1>
     bool operator==(const FastFixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ == other1.v;
+        return v_ == other1.v_;
     };
 
     template <size_t N1, size_t K1>
     bool operator==(const Fixed<N1, K1>& other) const {
         auto other1 = static_cast<FastFixed>(other);
-        return v_ == other1.v;
+        return v_ == other1.v_;
     };
 
     template <size_t N1, size_t K1>
@@ -154,7 +159,7 @@ public:
 
     template <size_t N1, size_t K1>
     friend FastFixed abs(FastFixed<N1, K1> x) {
-        return x.v < 0 ? FastFixed::from_raw(-static_cast<FastFixed>(x).v_) : x;
+        return x.v_ < 0 ? FastFixed::from_raw(-static_cast<FastFixed>(x).v_) : x;
     }
 
     friend std::ostream& operator<<(std::ostream& out, FastFixed x) {
@@ -176,7 +181,7 @@ public:
     template <size_t N1, size_t K1>
     friend FastFixed min(FastFixed& a, FastFixed<N1, K1>& b) {
         auto x = static_cast<FastFixed>(b);
-        if (a.v_ < x.v) {
+        if (a.v_ < x.v_) {
             return a;
         }
         return x;
@@ -185,7 +190,7 @@ public:
     template <size_t N1, size_t K1>
     friend FastFixed max(FastFixed& a, FastFixed<N1, K1>& b) {
         auto x = static_cast<FastFixed>(b);
-        if (a.v_ < x.v) {
+        if (a.v_ < x.v_) {
             return b;
         }
         return x;
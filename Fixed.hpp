@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+
 template <size_t N, size_t K>
 class FastFixed;
 
@@ -23,7 +28,7 @@ struct SelectIntType {
 
 template <size_t N, size_t K>
 class Fixed {
-    using Type = typename SelectIntType<N>::type;
+    using Type = typename SelectIntType<N>::Type;
     Type v_;
 
 public:
@@ -63,37 +68,37 @@ public:
     template <size_t OtherN, size_t OtherK>
     auto operator<(const Fixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ < other1.v;
+        return v_ < other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
     auto operator<=(const Fixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ <= other1.v;
+        return v_ <= other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
     auto operator<=(const FastFixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ <= other1.v;
+        return v_ <= other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
     auto operator>(const Fixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ > other1.v;
+        return v_ > other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
     auto operator>=(const Fixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ >= other1.v;
+        return v_ >= other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
     bool operator==(const Fixed<OtherN, OtherK>& other) const {
         auto other1 = static_cast<Fixed>(other);
-        return v_ == other1.v;
+        return v_ == other1.v_;
     };
 
     template <size_t OtherN, size_t OtherK>
@@ -154,7 +159,7 @@ public:
 
     template <size_t OtherN, size_t OtherK>
     friend Fixed abs(Fixed<OtherN, OtherK> x) {
-        return x.v < 0 ? Fixed::from_raw(-static_cast<Fixed<N, K>>(x).v_) : x;
+        return x.v_ < 0 ? Fixed::from_raw(-static_cast<Fixed<N, K>>(x).v_) : x;
     }
 
     friend std::ostream& operator<<(std::ostream& out, Fixed x) {
@@ -176,7 +181,7 @@ public:
     template <size_t OtherN, size_t OtherK>
     friend Fixed min(Fixed& a, Fixed<OtherN, OtherK>& b) {
         auto x = static_cast<Fixed>(b);
-        if (a.v_ < x.v) {
+        if (a.v_ < x.v_) {
             return a;
         }
         return x;
@@ -185,7 +190,7 @@ public:
     template <size_t OtherN, size_t OtherK>
     friend Fixed max(Fixed& a, Fixed<OtherN, OtherK>& b) {
         auto x = static_cast<Fixed>(b);
-        if (a.v_ < x.v) {
+        if (a.v_ < x.v_) {
             return x;
         }
         return a;
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <istream>
+#include <limits>
+#include <string>
+#include <vector>
+
+// Initial state in the input.txt format: "n m", n rows of the field, then rho_air, rho_fluid and g.
+// Each field row gets a trailing '\0' column, which is the layout Simulator expects.
+struct Input {
+    std::vector<std::vector<char>> field;
+    float rho_air = 0;
+    int rho_fluid = 0;
+    float g = 0;
+};
+
+inline bool ReadInput(std::istream& in, Input& input) {
+    int n, m;
+    if (!(in >> n >> m) || n <= 0 || m <= 0) {
+        return false;
+    }
+    input.field.assign(n, std::vector<char>(m + 1));
+    in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    std::string s;
+    for (int i = 0; i < n; ++i) {
+        if (!getline(in, s) || s.size() < static_cast<size_t>(m)) {
+            return false;
+        }
+        for (int j = 0; j < m; ++j) {
+            input.field[i][j] = s[j];
+        }
+        input.field[i][m] = '\0';
+    }
+
+    return static_cast<bool>(in >> input.rho_air >> input.rho_fluid >> input.g);
+}
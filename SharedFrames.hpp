@@ -0,0 +1,177 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Ring of frames in POSIX shared memory. The simulator writes each frame straight into the
+// mapping, so publishing is a plain memory copy with no syscalls. Readers map the same object
+// and use the per-slot sequence numbers as a seqlock to detect frames overwritten under them.
+//
+// layout: SharedFramesHeader, then `slots` slots of slot_size bytes, each
+//         FrameSlotHeader, field (rows * cols chars), [pressure floats], [velocity floats * 4]
+
+inline constexpr char frames_magic[4] = {'F', 'L', 'F', 'R'};
+inline constexpr uint32_t frames_version = 1;
+
+enum FramePlanes : uint32_t {
+    kFieldPlane = 1,
+    kPressurePlane = 2,
+    kVelocityPlane = 4,
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared frames need lock-free 64-bit atomics");
+
+struct SharedFramesHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t rows, cols;
+    uint32_t slots;
+    uint32_t planes;
+    uint64_t slot_size;
+    // Sequence number of the newest complete frame, 0 until the first one is published.
+    std::atomic<uint64_t> latest;
+};
+
+struct FrameSlotHeader {
+    // Sequence number of the frame held by the slot, 0 while it is being rewritten.
+    std::atomic<uint64_t> seq;
+    uint64_t tick;
+};
+
+inline size_t FramePayloadSize(size_t rows, size_t cols, uint32_t planes) {
+    size_t cells = rows * cols;
+    size_t size = cells;
+    if (planes & kPressurePlane) {
+        size = (size + alignof(float) - 1) / alignof(float) * alignof(float) + cells * sizeof(float);
+    }
+    if (planes & kVelocityPlane) {
+        size = (size + alignof(float) - 1) / alignof(float) * alignof(float) + 4 * cells * sizeof(float);
+    }
+    return size;
+}
+
+inline size_t FrameSlotSize(size_t rows, size_t cols, uint32_t planes) {
+    size_t size = sizeof(FrameSlotHeader) + FramePayloadSize(rows, cols, planes);
+    return (size + alignof(FrameSlotHeader) - 1) / alignof(FrameSlotHeader) * alignof(FrameSlotHeader);
+}
+
+inline char* FrameField(FrameSlotHeader* slot) {
+    return reinterpret_cast<char*>(slot + 1);
+}
+
+inline float* FramePressure(FrameSlotHeader* slot, size_t rows, size_t cols) {
+    size_t offset = (rows * cols + alignof(float) - 1) / alignof(float) * alignof(float);
+    return reinterpret_cast<float*>(FrameField(slot) + offset);
+}
+
+inline float* FrameVelocity(FrameSlotHeader* slot, size_t rows, size_t cols, uint32_t planes) {
+    size_t offset = (rows * cols + alignof(float) - 1) / alignof(float) * alignof(float);
+    if (planes & kPressurePlane) {
+        offset += rows * cols * sizeof(float);
+    }
+    return reinterpret_cast<float*>(FrameField(slot) + offset);
+}
+
+class FramePublisher {
+    std::string name_;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    SharedFramesHeader* header_ = nullptr;
+    uint64_t seq_ = 0;
+
+public:
+    FramePublisher() = default;
+    FramePublisher(const FramePublisher&) = delete;
+    FramePublisher& operator=(const FramePublisher&) = delete;
+
+    ~FramePublisher() {
+        if (data_ != nullptr) {
+            munmap(data_, size_);
+            shm_unlink(name_.c_str());
+        }
+    }
+
+    bool Open(const std::string& name, size_t rows, size_t cols, size_t slots, uint32_t planes) {
+        if (slots == 0) {
+            return false;
+        }
+        planes |= kFieldPlane;
+        size_t slot_size = FrameSlotSize(rows, cols, planes);
+        size_t size = sizeof(SharedFramesHeader) + slots * slot_size;
+
+        int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+
+        name_ = name;
+        data_ = data;
+        size_ = size;
+        header_ = static_cast<SharedFramesHeader*>(data);
+        std::memset(data, 0, size);
+        header_->version = frames_version;
+        header_->rows = static_cast<uint32_t>(rows);
+        header_->cols = static_cast<uint32_t>(cols);
+        header_->slots = static_cast<uint32_t>(slots);
+        header_->planes = planes;
+        header_->slot_size = slot_size;
+        header_->latest.store(0, std::memory_order_relaxed);
+        // Readers check the magic last, so a half-initialised header is never accepted.
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(header_->magic, frames_magic, sizeof(frames_magic));
+        return true;
+    }
+
+    template <typename Field, typename Pressure, typename Velocity>
+    void Publish(size_t tick, const Field& field, const Pressure& p, const Velocity& velocity) {
+        size_t rows = header_->rows, cols = header_->cols;
+        uint64_t seq = ++seq_;
+        auto* slot = reinterpret_cast<FrameSlotHeader*>(static_cast<char*>(data_) + sizeof(SharedFramesHeader)
+                                                        + (seq % header_->slots) * header_->slot_size);
+        slot->seq.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot->tick = tick;
+        char* cells = FrameField(slot);
+        for (size_t x = 0; x < rows; ++x) {
+            std::memcpy(cells + x * cols, &field[x][0], cols);
+        }
+        if (header_->planes & kPressurePlane) {
+            float* pressure = FramePressure(slot, rows, cols);
+            for (size_t x = 0; x < rows; ++x) {
+                for (size_t y = 0; y < cols; ++y) {
+                    pressure[x * cols + y] = static_cast<float>(p[x][y]);
+                }
+            }
+        }
+        if (header_->planes & kVelocityPlane) {
+            float* v = FrameVelocity(slot, rows, cols, header_->planes);
+            for (size_t x = 0; x < rows; ++x) {
+                for (size_t y = 0; y < cols; ++y) {
+                    const auto& cell = velocity.At(x, y);
+                    for (size_t i = 0; i < cell.size(); ++i) {
+                        v[(x * cols + y) * cell.size() + i] = static_cast<float>(cell[i]);
+                    }
+                }
+            }
+        }
+
+        slot->seq.store(seq, std::memory_order_release);
+        header_->latest.store(seq, std::memory_order_release);
+    }
+};
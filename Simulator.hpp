@@ -4,46 +4,98 @@
 #include <random>
 #include <cassert>
 #include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include "WorkerPool.hpp"
 
-constexpr size_t t = 5'000;
-constexpr size_t save_rate = 100;
 constexpr std::array<std::pair<int, int>, 4> deltas{{{-1, 0}, {1, 0}, {0, -1}, {0, 1}}};
-inline std::mt19937_64 rnd(1337);
 
 constexpr std::size_t mx_size = std::numeric_limits<std::size_t>::max();
 
-template <typename type_p, typename type_v, typename type_vf, size_t Rows, size_t Columns>
+// Per-instance settings, fixed at construction.
+struct SimulatorOptions {
+    // on_checkpoint runs every save_rate ticks.
+    size_t save_rate = 100;
+
+    // Rows per stripe of the flow phase's pre-pass, 0 turns the pre-pass off. The stripe layout
+    // decides which cycles the pre-pass saturates first, so it changes the results; flow_threads only
+    // says how many threads share the stripes and never does.
+    size_t flow_stripe_rows = 0;
+    size_t flow_threads = 1;
+
+    // Freezing of uniform quiescent blocks, see CoarsenBlocks() and RefineBlocks(). Frozen blocks
+    // skip every phase, gravity included: they keep their mean pressure and zero velocity until a
+    // neighbour thaws them, so turning the mode on changes the results.
+    bool adaptive_blocks = false;
+    size_t block_size = 8;
+    size_t coarsen_rate = 10;
+    float quiet_velocity = 0.01;
+    float quiet_pressure = 0.01;
+    // How much of a block's pressure magnitude freezing may redistribute or drop, relative.
+    float freeze_tolerance = 0.01;
+};
+
+// Rows and Columns fix the grid size at compile time, leaving them at mx_size gives the dynamic-size version.
+// Compact selects narrow types for the per-cell bookkeeping.
+template <typename type_p, typename type_v, typename type_vf, size_t Rows = mx_size, size_t Columns = mx_size, bool Compact = false>
 class Simulator {
 public:
     static constexpr bool is_static = Rows != mx_size && Columns != mx_size;
 
+    // Row-major in one allocation, indexed as grid[x][y] like the static arrays.
+    template <class Type>
+    struct Grid {
+        std::vector<Type> cells;
+        size_t cols = 0;
+        Grid() = default;
+        Grid(size_t rows, size_t cols1) : cells(rows * cols1), cols(cols1) {}
+
+        Type* operator[](size_t x) {
+            return cells.data() + x * cols;
+        }
+
+        const Type* operator[](size_t x) const {
+            return cells.data() + x * cols;
+        }
+    };
+
     template <class Type>
     using ArrayType = std::conditional_t<is_static,
             std::array<std::array<Type, Columns>, Rows>,
-            std::vector<std::vector<Type>>>;
+            Grid<Type>>;
 
     using Field = ArrayType<char>;
-    Field field{};
-
-    using IntArray = ArrayType<int>;
-    type_p rho[256];
-    size_t N, M;
-
-    ArrayType<type_p> p{}, old_p{};
-    IntArray dirs{}, last_use{};
-
-    int UT = 0;
-    type_v g;
 
+    // Row-major in one allocation, so there is no per-row vector overhead.
     template <typename type_cur>
     struct VectorField {
-        std::vector<std::vector<std::array<type_cur, deltas.size()>>> v;
-        VectorField(size_t n, size_t m) {
-            v.resize(n, std::vector<std::array<type_cur, deltas.size()>>(m));
-        }
+        std::vector<std::array<type_cur, deltas.size()>> v;
+        size_t m = 0;
+        VectorField(size_t n, size_t m1) : v(n * m1), m(m1) {}
         VectorField() = default;
-        void F(size_t n, size_t m) {
-            v.resize(n, std::vector<std::array<type_cur, deltas.size()>>(m));
+        void F(size_t n, size_t m1) {
+            v.resize(n * m1);
+            m = m1;
+        }
+
+        std::array<type_cur, deltas.size()> &At(int x, int y) {
+            return v[x * m + y];
+        }
+
+        const std::array<type_cur, deltas.size()> &At(int x, int y) const {
+            return v[x * m + y];
         }
 
         type_cur &Add(int x, int y, int dx, int dy, type_cur dv) {
@@ -53,10 +105,42 @@ public:
         type_cur &Get(int x, int y, int dx, int dy) {
             size_t i = std::ranges::find(deltas, std::pair(dx, dy)) - deltas.begin();
             assert(i < deltas.size());
-            return v[x][y][i];
+            return At(x, y)[i];
         }
     };
 
+    // Counters for benchmarks and tests.
+    struct Stats {
+        // Flow sweeps run so far: sweeps over single stripes in ParallelFlow() and over the whole grid after it.
+        size_t stripe_sweeps = 0, full_sweeps = 0;
+        // Blocks frozen right now and thaws so far, in adaptive mode.
+        size_t frozen_blocks = 0, thawed_blocks = 0;
+    };
+
+    // Observers are how the simulator reports progress. on_tick runs after every tick, on_checkpoint
+    // every options.save_rate ticks. Returning false from either stops Step(), which then returns false.
+    std::function<bool(const Simulator&, size_t tick, bool moved)> on_tick;
+    std::function<bool(const Simulator&, size_t tick)> on_checkpoint;
+
+private:
+    Field field{};
+
+    // In compact mode the neighbour count and visit epoch take 1 and 2 bytes per cell.
+    // The epoch then wraps quickly, NextEpoch() clears last_use before it does.
+    using DirsType = std::conditional_t<Compact, uint8_t, int>;
+    using EpochType = std::conditional_t<Compact, uint16_t, int>;
+    using DirsArray = ArrayType<DirsType>;
+    using EpochArray = ArrayType<EpochType>;
+    type_p rho[256];
+    size_t N, M;
+
+    ArrayType<type_p> p{}, old_p{};
+    DirsArray dirs{};
+    EpochArray last_use{};
+
+    EpochType UT = 0;
+    type_v g;
+
     struct ParticleParams {
         char type;
         type_p cur_p;
@@ -65,20 +149,111 @@ public:
         void SwapWith(int x, int y, VectorField<type_v>& velocity1, ArrayType<type_p> &p1, Field &field1) {
             std::swap(field1[x][y], type);
             std::swap(p1[x][y], cur_p);
-            std::swap(velocity1.v[x][y], v);
+            std::swap(velocity1.At(x, y), v);
         }
     };
 
     VectorField<type_v> velocity{};
     VectorField<type_vf> velocity_flow{};
 
-    explicit constexpr Simulator(const std::vector<std::vector<char>>& field1, float rho_air, int rho_fluid, float g1) noexcept
-    requires(is_static) : g(g1) {
-        std::cout << "Static version constructor called with sizes: " << Rows << " " << Columns - 1 << "\n";
+    // Worklists for PropagateStop and PropagateMove. A cell is on each stack at most once per sweep,
+    // so reserving N * M up front keeps them from reallocating in the move phase. A move frame's
+    // target is the frame above it, so it only holds its own cell.
+    struct StopFrame {
+        int x, y;
+        uint8_t dir;
+    };
+    struct MoveFrame {
+        int x, y;
+    };
+    std::vector<StopFrame> stop_stack;
+    std::vector<MoveFrame> move_stack;
+
+    // Adaptive mode: block_size x block_size blocks that are uniform and quiet get frozen into one
+    // aggregated cell, every cell holding the block's mean pressure and zero velocity. Frozen blocks
+    // are skipped by every phase until a neighbour disturbs them.
+    size_t block_rows = 0, block_cols = 0;
+    std::vector<uint8_t> frozen;
+    std::vector<char> frozen_type;
+    std::vector<type_p> frozen_p;
+
+    SimulatorOptions options;
+
+    // Started once when the pre-pass runs on more than one thread and reused by every tick's ParallelFlow().
+    std::unique_ptr<WorkerPool> flow_pool;
+    Stats stats;
+
+    // Each simulator draws from its own generator, so several of them can run in one process.
+    std::mt19937_64 rnd{1337};
+
+    size_t tick = 0;
+
+public:
+    // Checks what the simulator relies on without bounds checks: equal rows ending in a '\0' column,
+    // only '#', '.' and ' ' cells, walls all around, positive densities and usable options.
+    // Returns an empty string for valid input, otherwise what is wrong with it.
+    static std::string Validate(const std::vector<std::vector<char>>& grid, float rho_air, int rho_fluid, const SimulatorOptions& options1) {
+        if (grid.empty() || grid.front().size() < 2) {
+            return "grid is empty";
+        }
+        size_t rows = grid.size(), cols = grid.front().size();
+        if (is_static && (rows != Rows || cols != Columns)) {
+            return "grid is " + std::to_string(rows) + "x" + std::to_string(cols - 1) + ", expected "
+                   + std::to_string(Rows) + "x" + std::to_string(Columns - 1);
+        }
+        for (size_t x = 0; x < rows; ++x) {
+            if (grid[x].size() != cols) {
+                return "row " + std::to_string(x) + " has a different length";
+            }
+            if (grid[x].back() != '\0') {
+                return "row " + std::to_string(x) + " has no trailing '\\0' column";
+            }
+            for (size_t y = 0; y + 1 < cols; ++y) {
+                char ch = grid[x][y];
+                if (ch != '#' && ch != '.' && ch != ' ') {
+                    return "unknown cell '" + std::string(1, ch) + "' at " + std::to_string(x) + " " + std::to_string(y);
+                }
+                if ((x == 0 || x == rows - 1 || y == 0 || y == cols - 2) && ch != '#') {
+                    return "border cell " + std::to_string(x) + " " + std::to_string(y) + " is not a wall";
+                }
+            }
+        }
+        if (!(rho_air > 0) || rho_fluid <= 0) {
+            return "densities must be positive";
+        }
+        if (options1.save_rate == 0 || options1.flow_threads == 0 || options1.flow_stripe_rows == 1
+            || options1.block_size == 0 || options1.coarsen_rate == 0 || !(options1.freeze_tolerance >= 0)) {
+            return "invalid options";
+        }
+        return {};
+    }
+
+    // The way to build a simulator from untrusted input: validates everything first and reports
+    // the problem through error instead of constructing a simulator that would index out of bounds.
+    // Running out of memory or failing to start the flow threads is reported the same way.
+    static std::unique_ptr<Simulator> Create(const std::vector<std::vector<char>>& grid, float rho_air, int rho_fluid, float g1,
+                                             std::string& error, SimulatorOptions options1 = {}) {
+        error = Validate(grid, rho_air, rho_fluid, options1);
+        if (!error.empty()) {
+            return nullptr;
+        }
+        try {
+            return std::make_unique<Simulator>(grid, rho_air, rho_fluid, g1, options1);
+        } catch (const std::exception& e) {
+            error = e.what();
+            return nullptr;
+        }
+    }
+
+    // The constructors expect input that passes Validate().
+    explicit constexpr Simulator(const std::vector<std::vector<char>>& field1, float rho_air, int rho_fluid, float g1, SimulatorOptions options1 = {})
+    requires(is_static) : g(g1), options(options1) {
         N = field1.size();
         M = field1.front().size() - 1;
         velocity.F(N, M);
         velocity_flow.F(N, M);
+        stop_stack.reserve(N * M);
+        move_stack.reserve(N * M);
         for (std::size_t i = 0; auto& row : field) {
             const std::vector<char>& dynamic_field = field1[i];
             assert(dynamic_field.size() == row.size());
@@ -87,43 +262,126 @@ public:
         }
         rho[' '] = rho_air;
         rho['.'] = rho_fluid;
+        Prepare();
     }
 
-    explicit constexpr Simulator(const Field& field1, float rho_air, int rho_fluid, float g1) requires(!is_static) : Simulator(field1, rho_air, rho_fluid, g1, field1.size(), field1.front().size()) {};
+    explicit constexpr Simulator(const std::vector<std::vector<char>>& field1, float rho_air, int rho_fluid, float g1, SimulatorOptions options1 = {}) requires(!is_static) : Simulator(field1, rho_air, rho_fluid, g1, field1.size(), field1.front().size(), options1) {};
 
-    explicit constexpr Simulator(const Field& field1, float rho_air, int rho_fluid, float g1, size_t rows, size_t cols) requires(!is_static) : field(field1), p{rows, typename ArrayType<type_p>::value_type(cols)},
-                                                                                                                                                 old_p{rows, typename ArrayType<type_p>::value_type(cols)},
-                                                                                                                                                 dirs{rows, typename IntArray::value_type(cols)},
-                                                                                                                                                 last_use{rows, typename IntArray::value_type(cols)},
-                                                                                                                                                 g(g1) {
-        std::cout << "Dynamic version with sizes:" << field1.size() << " " << field1.front().size() - 1 << "\n";
+    explicit constexpr Simulator(const std::vector<std::vector<char>>& field1, float rho_air, int rho_fluid, float g1, size_t rows, size_t cols, SimulatorOptions options1 = {}) requires(!is_static) : field(rows, cols), p(rows, cols),
+                                                                                                                                                 old_p(rows, cols),
+                                                                                                                                                 dirs(rows, cols),
+                                                                                                                                                 last_use(rows, cols),
+                                                                                                                                                 g(g1), options(options1) {
         rho[' '] = rho_air;
         rho['.'] = rho_fluid;
         N = field1.size();
         M = field1.front().size() - 1;
-        velocity.f(N, M);
-        velocity_flow.f(N, M);
+        for (size_t x = 0; x < N; ++x) {
+            std::ranges::copy(field1[x], field[x]);
+        }
+        velocity.F(N, M);
+        velocity_flow.F(N, M);
+        stop_stack.reserve(N * M);
+        move_stack.reserve(N * M);
+        Prepare();
+    }
+
+    // Everything held per cell for the whole run: the state, the bookkeeping, the flow plane and
+    // the worklists reserved at N * M.
+    static constexpr size_t BytesPerCell() {
+        return sizeof(char) + 2 * sizeof(type_p) + sizeof(DirsType) + sizeof(EpochType) + deltas.size() * sizeof(type_v)
+               + FlowBytesPerCell() + WorklistBytesPerCell();
+    }
+
+    static constexpr size_t WorklistBytesPerCell() {
+        return sizeof(StopFrame) + sizeof(MoveFrame);
+    }
+
+    static constexpr size_t FlowBytesPerCell() {
+        return deltas.size() * sizeof(type_vf);
+    }
+
+    static void PrintMemoryReport(std::ostream& out) {
+        out << "Bytes per cell: " << BytesPerCell() << " (" << WorklistBytesPerCell() << " of them worklists, "
+            << FlowBytesPerCell() << " flow)" << (Compact ? ", compact state" : "") << "\n";
+    }
+
+    size_t RowCount() const {
+        return N;
+    }
+
+    size_t ColumnCount() const {
+        return M;
+    }
+
+    const Field& GetField() const {
+        return field;
+    }
+
+    const ArrayType<type_p>& Pressure() const {
+        return p;
+    }
+
+    const std::array<type_v, deltas.size()>& Velocity(size_t x, size_t y) const {
+        return velocity.At(x, y);
+    }
+
+    // The whole velocity plane, read through At(x, y).
+    const VectorField<type_v>& VelocityPlane() const {
+        return velocity;
+    }
+
+    const Stats& GetStats() const {
+        return stats;
+    }
+
+    // Ticks run so far, the next Step() starts with this one.
+    size_t Tick() const {
+        return tick;
+    }
+
+    const SimulatorOptions& Options() const {
+        return options;
     }
 
-    void SaveToFile() {
+    void PrintField(std::ostream& out) const {
+        for (size_t x = 0; x < N; ++x) {
+            for (size_t y = 0; y < M; ++y) {
+                out << static_cast<char>(field[x][y]);
+            }
+            out << "\n";
+        }
+    }
+
+    // Writes the state in the input format, so a dump can be fed back in as input.
+    void Save(std::ostream& out) const {
+        out << N << " " << M << "\n";
+        PrintField(out);
+
+        out << rho[' '] << "\n" << rho['.'] << "\n" << g << "\n";
+    }
+
+    bool SaveToFile(const std::string& path) const {
         std::ofstream f_out;
-        f_out.open("dump.txt");
+        f_out.open(path);
         if (!f_out) {
-            std::cerr << "Error during opening file\n";
-            exit(0);
+            return false;
         }
+        Save(f_out);
+        return static_cast<bool>(f_out);
+    }
 
-        f_out << N << " " << M << "\n";
-        for (const auto& row : field) {
-            for (const char ch : row) {
-                if (ch != '\0') {
-                    f_out << ch;
-                }
+private:
+    // Starts a new sweep. last_use only ever gets compared against the current UT and UT - 1,
+    // so dropping every mark back to 0 before the epoch overflows keeps all comparisons intact.
+    void NextEpoch() {
+        if (UT > std::numeric_limits<EpochType>::max() - 2) {
+            for (size_t x = 0; x < N; ++x) {
+                std::fill_n(&last_use[x][0], M, 0);
             }
-            f_out << "\n";
+            UT = 0;
         }
-
-        f_out << rho[' '] << "\n" << rho['.'] << "\n" << g << "\n";
+        UT += 2;
     }
 
     type_p Random01() {
@@ -137,27 +395,39 @@ public:
 
     }
 
-    void PropagateStop(int x, int y, bool force = false) {
-        if (!force) {
-            bool stop = true;
-            for (auto [dx, dy] : deltas) {
-                int nx = x + dx, ny = y + dy;
-                if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.Get(x, y, dx, dy) > static_cast<type_v>(0)) {
-                    stop = false;
-                    break;
-                }
-            }
-            if (!stop) {
-                return;
+    bool ShouldStop(int x, int y) {
+        for (auto [dx, dy] : deltas) {
+            int nx = x + dx, ny = y + dy;
+            if (field[nx][ny] != '#' && last_use[nx][ny] < UT - 1 && velocity.Get(x, y, dx, dy) > static_cast<type_v>(0)) {
+                return false;
             }
         }
+        return true;
+    }
+
+    // Depth-first like the recursive version it replaces: a frame resumes from the
+    // neighbour after the one it descended into, so cells are marked in the same order.
+    void PropagateStop(int x, int y, bool force = false) {
+        if (!force && !ShouldStop(x, y)) {
+            return;
+        }
         last_use[x][y] = UT;
-        for (auto [dx, dy] : deltas) {
-            int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] == '#' || last_use[nx][ny] == UT || velocity.Get(x, y, dx, dy) > static_cast<type_v>(0)) {
+        stop_stack.push_back({x, y, 0});
+        while (!stop_stack.empty()) {
+            StopFrame& frame = stop_stack.back();
+            if (frame.dir == deltas.size()) {
+                stop_stack.pop_back();
+                continue;
+            }
+            auto [dx, dy] = deltas[frame.dir++];
+            int nx = frame.x + dx, ny = frame.y + dy;
+            if (field[nx][ny] == '#' || last_use[nx][ny] == UT || velocity.Get(frame.x, frame.y, dx, dy) > static_cast<type_v>(0) || IsFrozen(nx, ny)) {
                 continue;
             }
-            PropagateStop(nx, ny);
+            if (ShouldStop(nx, ny)) {
+                last_use[nx][ny] = UT;
+                stop_stack.push_back({nx, ny, 0});
+            }
         }
     }
 
@@ -177,43 +447,42 @@ public:
         return sum;
     }
 
-    bool PropagateMove(int x, int y, bool is_first) {
-        last_use[x][y] = UT - is_first;
-        bool ret = false;
-        int nx = -1, ny = -1;
-        do {
-            std::array<type_p, deltas.size()> tres;
-            type_p sum = 0;
-            for (size_t i = 0; i < deltas.size(); ++i) {
-                auto [dx, dy] = deltas[i];
-                int nx1 = x + dx, ny1 = y + dy;
-                if (field[nx1][ny1] == '#' || last_use[nx1][ny1] == UT) {
-                    tres[i] = sum;
-                    continue;
-                }
-                auto v = velocity.Get(x, y, dx, dy);
-                if (v < static_cast<type_v>(0)) {
-                    tres[i] = sum;
-                    continue;
-                }
-                sum += static_cast<type_p>(v);
+    // Picks the next cell of the path out of (x, y), or returns false when no neighbour can take the particle.
+    bool ChooseMove(int x, int y, int& nx, int& ny) {
+        std::array<type_p, deltas.size()> tres;
+        type_p sum = 0;
+        for (size_t i = 0; i < deltas.size(); ++i) {
+            auto [dx, dy] = deltas[i];
+            int nx1 = x + dx, ny1 = y + dy;
+            if (field[nx1][ny1] == '#' || last_use[nx1][ny1] == UT) {
                 tres[i] = sum;
+                continue;
             }
-
-            if (sum == static_cast<type_p>(0)) {
-                break;
+            auto v = velocity.Get(x, y, dx, dy);
+            if (v < static_cast<type_v>(0)) {
+                tres[i] = sum;
+                continue;
             }
+            sum += static_cast<type_p>(v);
+            tres[i] = sum;
+        }
 
-            auto p = static_cast<type_p>(Random01() * sum);
-            size_t d = std::ranges::upper_bound(tres, p) - tres.begin();
+        if (sum == static_cast<type_p>(0)) {
+            return false;
+        }
+
+        auto p = static_cast<type_p>(Random01() * sum);
+        size_t d = std::ranges::upper_bound(tres, p) - tres.begin();
 
-            auto [dx, dy] = deltas[d];
-            nx = x + dx;
-            ny = y + dy;
-            assert(velocity.Get(x, y, dx, dy) > static_cast<type_v>(0) && field[nx][ny] != '#' && last_use[nx][ny] < UT);
+        auto [dx, dy] = deltas[d];
+        nx = x + dx;
+        ny = y + dy;
+        assert(velocity.Get(x, y, dx, dy) > static_cast<type_v>(0) && field[nx][ny] != '#' && last_use[nx][ny] < UT);
+        return true;
+    }
 
-            ret = (last_use[nx][ny] == UT - 1 || PropagateMove(nx, ny, false));
-        } while (!ret);
+    // Ends the visit of (x, y). If the path succeeded, the particle moves on to (nx, ny).
+    void FinishMove(int x, int y, int nx, int ny, bool ret, bool is_first) {
         last_use[x][y] = UT;
         for (auto [dx, dy] : deltas) {
             int nx1 = x + dx, ny1 = y + dy;
@@ -229,15 +498,44 @@ public:
                 pp.SwapWith(x, y, velocity, p, field);
             }
         }
+    }
+
+    // Walks the path with an explicit stack of frames instead of recursing per cell.
+    // A frame whose child path failed draws again, exactly as the recursive loop did,
+    // so the RNG is consumed in the same order. (nx, ny) is where the top frame's particle
+    // goes once the path succeeded: the cell that ended it, then each popped frame in turn.
+    bool PropagateMove(int x, int y, bool is_first) {
+        last_use[x][y] = static_cast<EpochType>(UT - is_first);
+        move_stack.push_back({x, y});
+        bool ret = false;
+        int nx = -1, ny = -1;
+        while (!move_stack.empty()) {
+            MoveFrame frame = move_stack.back();
+            if (!ret && ChooseMove(frame.x, frame.y, nx, ny)) {
+                if (last_use[nx][ny] == UT - 1) {
+                    ret = true;
+                } else {
+                    last_use[nx][ny] = UT;
+                    move_stack.push_back({nx, ny});
+                    continue;
+                }
+            }
+            move_stack.pop_back();
+            FinishMove(frame.x, frame.y, nx, ny, ret, is_first && move_stack.empty());
+            nx = frame.x;
+            ny = frame.y;
+        }
         return ret;
     }
 
-    std::tuple<type_p, bool, std::pair<int, int>> PropagateFlow(int x, int y, type_p lim) {
-        last_use[x][y] = UT - 1;
+    // Epoch and rows [lo, hi) are parameters so that row stripes can run their own sweeps in parallel:
+    // a search never leaves its stripe and only touches last_use and velocity_flow of its own cells.
+    std::tuple<type_p, bool, std::pair<int, int>> PropagateFlow(int x, int y, type_p lim, EpochType ut, int lo, int hi) {
+        last_use[x][y] = static_cast<EpochType>(ut - 1);
         type_p ret = 0;
         for (auto [dx, dy] : deltas) {
             int nx = x + dx, ny = y + dy;
-            if (field[nx][ny] != '#' && last_use[nx][ny] < UT) {
+            if (field[nx][ny] != '#' && nx >= lo && nx < hi && last_use[nx][ny] < ut) {
                 auto cap = velocity.Get(x, y, dx, dy);
                 auto flow = velocity_flow.Get(x, y, dx, dy);
                 if (flow == static_cast<type_vf>(cap)) {
@@ -245,26 +543,235 @@ public:
                 }
                 type_v res = cap - static_cast<type_v>(flow);
                 auto vp = std::min(lim, static_cast<type_p>(res));
-                if (last_use[nx][ny] == UT - 1) {
+                if (last_use[nx][ny] == ut - 1) {
                     velocity_flow.Add(x, y, dx, dy, static_cast<type_vf>(vp));
-                    last_use[x][y] = UT;
+                    last_use[x][y] = ut;
                     return {vp, 1, {nx, ny}};
                 }
-                auto [t, prop, end] = PropagateFlow(nx, ny, vp);
+                auto [t, prop, end] = PropagateFlow(nx, ny, vp, ut, lo, hi);
                 ret += t;
                 if (prop) {
                     velocity_flow.Add(x, y, dx, dy, static_cast<type_vf>(t));
-                    last_use[x][y] = UT;
+                    last_use[x][y] = ut;
                     return {t, end != std::pair(x, y), end};
                 }
             }
         }
-        last_use[x][y] = UT;
+        last_use[x][y] = ut;
         return {ret, 0, {0, 0}};
     }
 
+    bool FlowSweep(size_t lo, size_t hi, EpochType ut) {
+        bool prop = false;
+        for (size_t x = lo; x < hi; ++x) {
+            for (size_t y = 0; y < M; ++y) {
+                if (SkipFrozen(x, y)) {
+                    continue;
+                }
+                if (field[x][y] != '#' && last_use[x][y] != ut) {
+                    auto [t, local_prop, _] = PropagateFlow(x, y, 1, ut, lo, hi);
+                    if (t > static_cast<type_p>(0)) {
+                        prop = true;
+                    }
+                }
+            }
+        }
+        return prop;
+    }
+
+    // Saturates the cycles that fit inside a stripe of flow_stripe_rows rows, with stripes handed out
+    // to flow_threads threads through a shared counter. Each stripe counts its own epochs up from UT,
+    // and UT then jumps past the highest one. A stripe's sweeps only depend on its own cells, so the
+    // result is the same for any number of threads. Cycles crossing stripes are left to the
+    // sequential sweeps after it.
+    void ParallelFlow() {
+        size_t stripes = N / options.flow_stripe_rows;
+        if (stripes < 2) {
+            return;
+        }
+        std::vector<EpochType> reached(stripes, UT);
+        std::atomic<size_t> next{0};
+        auto worker = [&] {
+            for (size_t s = next++; s < stripes; s = next++) {
+                size_t lo = N * s / stripes, hi = N * (s + 1) / stripes;
+                EpochType ut = UT;
+                while (ut <= std::numeric_limits<EpochType>::max() - 2) {
+                    ut += 2;
+                    if (!FlowSweep(lo, hi, ut)) {
+                        break;
+                    }
+                }
+                reached[s] = ut;
+            }
+        };
+        if (flow_pool) {
+            flow_pool->Run(worker);
+        } else {
+            worker();
+        }
+        for (EpochType ut : reached) {
+            stats.stripe_sweeps += (ut - UT) / 2;
+        }
+        UT = std::ranges::max(reached);
+    }
+
+    // Calls fn(y0, y1) for the column ranges of row x that the phases of a tick can read or write:
+    // all of it in the default mode, otherwise the active blocks and, as RefineBlocks() relies on,
+    // the border cells of frozen blocks. Ranges may overlap.
+    template <typename Fn>
+    void ForEachReachable(size_t x, Fn&& fn) const {
+        size_t size = options.block_size;
+        if (!options.adaptive_blocks || x % size == 0 || x % size == size - 1 || x == N - 1) {
+            fn(0, M);
+            return;
+        }
+        size_t start = 0;
+        for (size_t by = 0; by < block_cols; ++by) {
+            if (frozen[x / size * block_cols + by]) {
+                size_t y0 = by * size, y1 = std::min(y0 + size, M);
+                fn(start, y0 + 1);
+                start = y1 - 1;
+            }
+        }
+        fn(start, M);
+    }
+
+    bool IsFrozen(size_t x, size_t y) const {
+        return options.adaptive_blocks && frozen[x / options.block_size * block_cols + y / options.block_size];
+    }
+
+    // Row-major sweeps call this per cell. On a frozen block it moves y to the block's last column,
+    // so the loop's ++y continues with the next block and the default mode keeps its visiting order.
+    bool SkipFrozen(size_t x, size_t& y) const {
+        if (!IsFrozen(x, y)) {
+            return false;
+        }
+        y = std::min((y / options.block_size + 1) * options.block_size, M) - 1;
+        return true;
+    }
+
+    bool Quiet(type_v v) const {
+        return v <= static_cast<type_v>(options.quiet_velocity) && static_cast<type_v>(-options.quiet_velocity) <= v;
+    }
+
+    bool Quiet(const std::array<type_v, deltas.size()>& v) const {
+        return std::ranges::all_of(v, [this](type_v v1) { return Quiet(v1); });
+    }
+
+    bool Close(type_p a, type_p b) const {
+        return a - b <= static_cast<type_p>(options.quiet_pressure) && b - a <= static_cast<type_p>(options.quiet_pressure);
+    }
+
+    // Freezes blocks made of one kind of cell with small velocities and a flat pressure. Freezing
+    // flattens the pressure to the block's mean and zeroes the velocities, so a block is only frozen
+    // when both are small next to the pressure it holds: the pressure moved between cells, sum |p - mean|,
+    // and the momentum dropped, sum rho * |v| as the flow phase would turn it into pressure, must each
+    // stay within freeze_tolerance of sum |p|. Blocks whose neighbours would thaw them right away are skipped.
+    void CoarsenBlocks() {
+        auto abs = [](auto a) { return a < static_cast<decltype(a)>(0) ? -a : a; };
+        for (size_t bx = 0; bx < block_rows; ++bx) {
+            for (size_t by = 0; by < block_cols; ++by) {
+                size_t b = bx * block_cols + by;
+                if (frozen[b]) {
+                    continue;
+                }
+                size_t x0 = bx * options.block_size, x1 = std::min(x0 + options.block_size, N);
+                size_t y0 = by * options.block_size, y1 = std::min(y0 + options.block_size, M);
+                char type = field[x0][y0];
+                bool uniform = type != '#';
+                type_p lo = p[x0][y0], hi = p[x0][y0], total = 0;
+                for (size_t x = x0; x < x1 && uniform; ++x) {
+                    for (size_t y = y0; y < y1 && uniform; ++y) {
+                        uniform = field[x][y] == type && Quiet(velocity.At(x, y));
+                        lo = std::min(lo, p[x][y]);
+                        hi = std::max(hi, p[x][y]);
+                        total += p[x][y];
+                    }
+                }
+                if (!uniform || !Close(lo, hi)) {
+                    continue;
+                }
+
+                type_p mean = total / static_cast<type_p>(static_cast<int>((x1 - x0) * (y1 - y0)));
+                type_p magnitude = 0, moved = 0, dropped = 0;
+                bool calm = true;
+                for (size_t x = x0; x < x1; ++x) {
+                    for (size_t y = y0; y < y1; ++y) {
+                        magnitude += abs(p[x][y]);
+                        moved += abs(p[x][y] - mean);
+                        for (auto v : velocity.At(x, y)) {
+                            dropped += static_cast<type_p>(abs(v)) * rho[static_cast<int>(type)];
+                        }
+                        for (auto [dx, dy] : deltas) {
+                            int nx = static_cast<int>(x) + dx, ny = static_cast<int>(y) + dy;
+                            bool outside = nx < static_cast<int>(x0) || nx >= static_cast<int>(x1) || ny < static_cast<int>(y0) || ny >= static_cast<int>(y1);
+                            if (outside && field[nx][ny] != '#' && !IsFrozen(nx, ny) && !Close(p[nx][ny], mean)) {
+                                calm = false;
+                            }
+                        }
+                    }
+                }
+                type_p limit = magnitude * static_cast<type_p>(options.freeze_tolerance);
+                if (moved > limit || dropped > limit || !calm) {
+                    continue;
+                }
+
+                for (size_t x = x0; x < x1; ++x) {
+                    for (size_t y = y0; y < y1; ++y) {
+                        p[x][y] = mean;
+                        velocity.At(x, y) = {};
+                        velocity_flow.At(x, y) = {};
+                    }
+                }
+                frozen[b] = 1;
+                ++stats.frozen_blocks;
+                frozen_type[b] = type;
+                frozen_p[b] = mean;
+            }
+        }
+    }
+
+    // Active neighbours can only write one cell deep into a frozen block, so checking its border is
+    // enough. A block thaws when a border cell changed kind, picked up velocity or pressure, or when
+    // the pressure across the block edge differs by more than quiet_pressure.
+    void RefineBlocks() {
+        for (size_t bx = 0; bx < block_rows; ++bx) {
+            for (size_t by = 0; by < block_cols; ++by) {
+                size_t b = bx * block_cols + by;
+                if (!frozen[b]) {
+                    continue;
+                }
+                size_t x0 = bx * options.block_size, x1 = std::min(x0 + options.block_size, N);
+                size_t y0 = by * options.block_size, y1 = std::min(y0 + options.block_size, M);
+                bool disturbed = false;
+                auto check = [&](size_t x, size_t y) {
+                    disturbed |= field[x][y] != frozen_type[b] || !Close(p[x][y], frozen_p[b])
+                                 || !Quiet(velocity.At(x, y));
+                    for (auto [dx, dy] : deltas) {
+                        int nx = static_cast<int>(x) + dx, ny = static_cast<int>(y) + dy;
+                        if (field[nx][ny] != '#' && !IsFrozen(nx, ny) && !Close(p[nx][ny], frozen_p[b])) {
+                            disturbed = true;
+                        }
+                    }
+                };
+                for (size_t x = x0; x < x1; ++x) {
+                    check(x, y0);
+                    check(x, y1 - 1);
+                }
+                for (size_t y = y0; y < y1; ++y) {
+                    check(x0, y);
+                    check(x1 - 1, y);
+                }
+                if (disturbed) {
+                    frozen[b] = 0;
+                    ++stats.thawed_blocks;
+                    --stats.frozen_blocks;
+                }
+            }
+        }
+    }
 
-    void Run() {
+    void Prepare() {
         for (size_t x = 0; x < N; ++x) {
             for (size_t y = 0; y < M; ++y) {
                 if (field[x][y] == '#') {
@@ -276,12 +783,28 @@ public:
             }
         }
 
-        for (size_t i = 0; i < t; ++i) {
+        if (options.adaptive_blocks) {
+            block_rows = (N + options.block_size - 1) / options.block_size;
+            block_cols = (M + options.block_size - 1) / options.block_size;
+            frozen.assign(block_rows * block_cols, 0);
+            frozen_type.assign(block_rows * block_cols, '\0');
+            frozen_p.assign(block_rows * block_cols, 0);
+        }
 
+        if (options.flow_stripe_rows > 0 && options.flow_threads > 1) {
+            flow_pool = std::make_unique<WorkerPool>(options.flow_threads);
+        }
+    }
+
+public:
+    // Advances the simulation by n ticks, continuing from where the previous call stopped.
+    bool Step(size_t n) {
+        for (size_t end = tick + n; tick < end; ++tick) {
+            size_t i = tick;
             type_p total_delta_p = 0;
             for (size_t x = 0; x < N; ++x) {
                 for (size_t y = 0; y < M; ++y) {
-                    if (field[x][y] == '#') {
+                    if (field[x][y] == '#' || SkipFrozen(x, y)) {
                         continue;
                     }
                     if (field[x + 1][y] != '#') {
@@ -290,14 +813,18 @@ public:
                 }
             }
 
-            for (int i1 = 0; i1 < p.size(); ++i1) {
-                for (int j1 = 0; j1 < p.front().size(); ++j1) {
-                    old_p[i1][j1] = p[i1][j1];
+            if (options.adaptive_blocks) {
+                for (size_t x = 0; x < N; ++x) {
+                    ForEachReachable(x, [&](size_t y0, size_t y1) {
+                        std::copy_n(&p[x][y0], y1 - y0, &old_p[x][y0]);
+                    });
                 }
+            } else {
+                old_p = p;
             }
             for (size_t x = 0; x < N; ++x) {
                 for (size_t y = 0; y < M; ++y) {
-                    if (field[x][y] == '#') {
+                    if (field[x][y] == '#' || SkipFrozen(x, y)) {
                         continue;
                     }
                     for (auto [dx, dy] : deltas) {
@@ -320,26 +847,24 @@ public:
                 }
             }
 
-            velocity_flow = {N, M};
+            for (size_t x = 0; x < N; ++x) {
+                ForEachReachable(x, [&](size_t y0, size_t y1) {
+                    std::fill_n(&velocity_flow.At(x, y0), y1 - y0, std::array<type_vf, deltas.size()>{});
+                });
+            }
+            if (options.flow_stripe_rows > 0) {
+                ParallelFlow();
+            }
             bool prop = false;
             do {
-                UT += 2;
-                prop = false;
-                for (size_t x = 0; x < N; ++x) {
-                    for (size_t y = 0; y < M; ++y) {
-                        if (field[x][y] != '#' && last_use[x][y] != UT) {
-                            auto [t, local_prop, _] = PropagateFlow(x, y, 1);
-                            if (t > static_cast<type_p>(0)) {
-                                prop = true;
-                            }
-                        }
-                    }
-                }
+                NextEpoch();
+                prop = FlowSweep(0, N, UT);
+                ++stats.full_sweeps;
             } while (prop);
 
             for (size_t x = 0; x < N; ++x) {
                 for (size_t y = 0; y < M; ++y) {
-                    if (field[x][y] == '#') {
+                    if (field[x][y] == '#' || SkipFrozen(x, y)) {
                         continue;
                     }
                     for (auto [dx, dy] : deltas) {
@@ -364,10 +889,13 @@ public:
                 }
             }
 
-            UT += 2;
+            NextEpoch();
             prop = false;
             for (size_t x = 0; x < N; ++x) {
                 for (size_t y = 0; y < M; ++y) {
+                    if (SkipFrozen(x, y)) {
+                        continue;
+                    }
                     if (field[x][y] != '#' && last_use[x][y] != UT) {
                         if (Random01() < MoveProb(x, y)) {
                             prop = true;
@@ -379,19 +907,22 @@ public:
                 }
             }
 
-            if (prop) {
-                std::cout << "Tick " << i << ":\n";
-                for (size_t x = 0; x < N; ++x) {
-                    for (size_t y = 0; y < M; ++y) {
-                        std::cout << static_cast<char>(field[x][y]);
-                    }
-                    std::cout << "\n";
+            if (options.adaptive_blocks) {
+                RefineBlocks();
+                if (i % options.coarsen_rate == 0) {
+                    CoarsenBlocks();
                 }
             }
 
-            if (i % save_rate == 0) {
-                SaveToFile();
+            if (on_tick && !on_tick(*this, i, prop)) {
+                ++tick;
+                return false;
+            }
+            if (i % options.save_rate == 0 && on_checkpoint && !on_checkpoint(*this, i)) {
+                ++tick;
+                return false;
             }
         }
+        return true;
     }
 };
@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Binary trajectory: a keyframe with the whole field every keyframe_rate ticks
+// and, in between, only the runs of cells whose char changed since the last record.
+// Every written tick gets a record, an unchanged tick is a delta with zero runs,
+// so the last record tells where the trajectory ends.
+//
+// header:   "FLTJ" version N M keyframe_rate [planes]
+// keyframe: 'K' tick N*M chars [N*M pressure] [4*N*M velocity]
+// delta:    'D' tick runs {gap length chars[length]}* [pressure runs] [velocity runs]
+// All integers except version are unsigned LEB128 varints, gap counts cells since the end of the previous run.
+//
+// Version 3 adds the planes flags to the header. The pressure and velocity planes it selects are
+// stored as floats in host byte order, whole in keyframes and in deltas as runs of the values whose
+// bits changed, encoded like the runs of chars. Without planes the writer keeps producing version 2.
+
+inline constexpr char trajectory_magic[4] = {'F', 'L', 'T', 'J'};
+inline constexpr uint8_t trajectory_version = 2;
+inline constexpr uint8_t trajectory_planes_version = 3;
+
+enum TrajectoryPlanes : uint32_t {
+    kTrajectoryPressure = 1,
+    kTrajectoryVelocity = 2,
+};
+
+inline void WriteVarint(std::ostream& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.put(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.put(static_cast<char>(value));
+}
+
+inline bool ReadVarint(std::istream& in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == std::char_traits<char>::eof()) {
+            return false;
+        }
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class TrajectoryWriter {
+    std::ofstream out_;
+    size_t n_ = 0, m_ = 0;
+    size_t keyframe_rate_ = 0;
+    uint32_t planes_ = 0;
+    std::vector<char> prev_, cur_;
+    // Float bits of the recorded planes, so deltas compare values exactly.
+    std::vector<uint32_t> prev_p_, cur_p_, prev_v_, cur_v_;
+    bool has_prev_ = false;
+
+public:
+    bool Open(const std::string& path, size_t n, size_t m, size_t keyframe_rate, uint32_t planes = 0) {
+        out_.open(path, std::ios::binary | std::ios::trunc);
+        if (!out_) {
+            return false;
+        }
+        n_ = n;
+        m_ = m;
+        keyframe_rate_ = keyframe_rate;
+        planes_ = planes & (kTrajectoryPressure | kTrajectoryVelocity);
+        prev_.assign(n * m, '\0');
+        cur_.assign(n * m, '\0');
+        size_t p_size = planes_ & kTrajectoryPressure ? n * m : 0;
+        size_t v_size = planes_ & kTrajectoryVelocity ? 4 * n * m : 0;
+        prev_p_.assign(p_size, 0);
+        cur_p_.assign(p_size, 0);
+        prev_v_.assign(v_size, 0);
+        cur_v_.assign(v_size, 0);
+        has_prev_ = false;
+
+        out_.write(trajectory_magic, sizeof(trajectory_magic));
+        out_.put(static_cast<char>(planes_ ? trajectory_planes_version : trajectory_version));
+        WriteVarint(out_, n_);
+        WriteVarint(out_, m_);
+        WriteVarint(out_, keyframe_rate_);
+        if (planes_) {
+            WriteVarint(out_, planes_);
+        }
+        return static_cast<bool>(out_);
+    }
+
+    // Records the state of field after the given tick, along with the planes selected in Open().
+    // velocity.At(x, y) gives the four directions of a cell. Ticks without changes cost a few bytes
+    // between keyframes.
+    template <typename Field, typename Pressure, typename Velocity>
+    void Write(size_t tick, const Field& field, const Pressure& p, const Velocity& velocity) {
+        for (size_t x = 0; x < n_; ++x) {
+            for (size_t y = 0; y < m_; ++y) {
+                cur_[x * m_ + y] = field[x][y];
+            }
+        }
+        if (planes_ & kTrajectoryPressure) {
+            for (size_t x = 0; x < n_; ++x) {
+                for (size_t y = 0; y < m_; ++y) {
+                    cur_p_[x * m_ + y] = FloatBits(static_cast<float>(p[x][y]));
+                }
+            }
+        }
+        if (planes_ & kTrajectoryVelocity) {
+            for (size_t x = 0; x < n_; ++x) {
+                for (size_t y = 0; y < m_; ++y) {
+                    const auto& cell = velocity.At(x, y);
+                    for (size_t i = 0; i < cell.size(); ++i) {
+                        cur_v_[(x * m_ + y) * 4 + i] = FloatBits(static_cast<float>(cell[i]));
+                    }
+                }
+            }
+        }
+        WriteRecord(tick);
+    }
+
+    void Flush() {
+        out_.flush();
+    }
+
+private:
+    static uint32_t FloatBits(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    void WriteRecord(size_t tick) {
+        if (!has_prev_ || tick % keyframe_rate_ == 0) {
+            out_.put('K');
+            WriteVarint(out_, tick);
+            WriteWhole(cur_);
+            WriteWhole(cur_p_);
+            WriteWhole(cur_v_);
+        } else {
+            out_.put('D');
+            WriteVarint(out_, tick);
+            WriteRuns(cur_, prev_);
+            if (planes_ & kTrajectoryPressure) {
+                WriteRuns(cur_p_, prev_p_);
+            }
+            if (planes_ & kTrajectoryVelocity) {
+                WriteRuns(cur_v_, prev_v_);
+            }
+        }
+        std::swap(prev_, cur_);
+        std::swap(prev_p_, cur_p_);
+        std::swap(prev_v_, cur_v_);
+        has_prev_ = true;
+    }
+
+    template <typename T>
+    void WriteWhole(const std::vector<T>& values) {
+        out_.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+    }
+
+    template <typename T>
+    void WriteRuns(const std::vector<T>& cur, const std::vector<T>& prev) {
+        std::vector<std::pair<size_t, size_t>> runs;
+        for (size_t i = 0; i < cur.size();) {
+            if (cur[i] == prev[i]) {
+                ++i;
+                continue;
+            }
+            size_t j = i;
+            while (j < cur.size() && cur[j] != prev[j]) {
+                ++j;
+            }
+            runs.emplace_back(i, j - i);
+            i = j;
+        }
+
+        WriteVarint(out_, runs.size());
+        size_t end = 0;
+        for (auto [start, len] : runs) {
+            WriteVarint(out_, start - end);
+            WriteVarint(out_, len);
+            out_.write(reinterpret_cast<const char*>(cur.data() + start), static_cast<std::streamsize>(len * sizeof(T)));
+            end = start + len;
+        }
+    }
+};
+
+class TrajectoryReader {
+public:
+    struct Record {
+        size_t tick;
+        bool keyframe;
+        std::streampos offset;
+    };
+
+    // The state after a tick, row-major. The planes stay empty unless the trajectory has them,
+    // velocity holds the four directions of each cell in a row.
+    struct Frame {
+        std::vector<char> cells;
+        std::vector<float> pressure, velocity;
+    };
+
+private:
+    std::ifstream in_;
+    size_t n_ = 0, m_ = 0;
+    size_t keyframe_rate_ = 0;
+    uint32_t planes_ = 0;
+    std::vector<Record> records_;
+    std::streampos end_;
+    // Index of the record Next() applies, valid after a successful Seek().
+    size_t cursor_ = 0;
+
+public:
+    bool Open(const std::string& path) {
+        in_.open(path, std::ios::binary | std::ios::ate);
+        if (!in_) {
+            return false;
+        }
+        end_ = in_.tellg();
+        in_.seekg(0);
+
+        char magic[sizeof(trajectory_magic)];
+        in_.read(magic, sizeof(magic));
+        if (!in_ || !std::equal(std::begin(magic), std::end(magic), std::begin(trajectory_magic))) {
+            return false;
+        }
+        int version = in_.get();
+        if (version != trajectory_version && version != trajectory_planes_version) {
+            return false;
+        }
+        uint64_t n, m, rate, planes = 0;
+        if (!ReadVarint(in_, n) || !ReadVarint(in_, m) || !ReadVarint(in_, rate)
+            || (version == trajectory_planes_version && !ReadVarint(in_, planes))) {
+            return false;
+        }
+        if (planes & ~uint64_t{kTrajectoryPressure | kTrajectoryVelocity}) {
+            return false;
+        }
+        n_ = n;
+        m_ = m;
+        keyframe_rate_ = rate;
+        planes_ = static_cast<uint32_t>(planes);
+        return Index();
+    }
+
+    size_t Rows() const {
+        return n_;
+    }
+
+    size_t Columns() const {
+        return m_;
+    }
+
+    size_t KeyframeRate() const {
+        return keyframe_rate_;
+    }
+
+    // TrajectoryPlanes flags of the planes recorded along with the field.
+    uint32_t Planes() const {
+        return planes_;
+    }
+
+    const std::vector<Record>& Records() const {
+        return records_;
+    }
+
+    // Restores the state as it was after the given tick. Fails for ticks that were never written.
+    bool Seek(size_t tick, Frame& frame) {
+        auto it = std::ranges::lower_bound(records_, tick, {}, &Record::tick);
+        if (it == records_.end() || it->tick != tick) {
+            return false;
+        }
+        auto key = it;
+        while (!key->keyframe) {
+            if (key == records_.begin()) {
+                return false;
+            }
+            --key;
+        }
+
+        frame.cells.assign(n_ * m_, '\0');
+        frame.pressure.assign(planes_ & kTrajectoryPressure ? n_ * m_ : 0, 0.0f);
+        frame.velocity.assign(planes_ & kTrajectoryVelocity ? 4 * n_ * m_ : 0, 0.0f);
+        for (; key != it + 1; ++key) {
+            if (!Apply(*key, frame)) {
+                return false;
+            }
+        }
+        cursor_ = it + 1 - records_.begin();
+        return true;
+    }
+
+    // Advances frame, as left by Seek() or the previous Next(), by one record.
+    bool Next(size_t& tick, Frame& frame) {
+        if (cursor_ >= records_.size() || !Apply(records_[cursor_], frame)) {
+            return false;
+        }
+        tick = records_[cursor_++].tick;
+        return true;
+    }
+
+private:
+    // A record cut short by an interrupted run is dropped, everything before it stays seekable.
+    bool Index() {
+        records_.clear();
+        while (true) {
+            std::streampos offset = in_.tellg();
+            int kind = in_.get();
+            if (kind == std::char_traits<char>::eof()) {
+                return !records_.empty();
+            }
+            uint64_t tick;
+            if ((kind != 'K' && kind != 'D') || !ReadVarint(in_, tick) || !SkipPayload(kind == 'K')) {
+                return !records_.empty();
+            }
+            records_.push_back({tick, kind == 'K', offset});
+        }
+    }
+
+    bool SkipPayload(bool keyframe) {
+        if (keyframe) {
+            size_t bytes = n_ * m_;
+            if (planes_ & kTrajectoryPressure) {
+                bytes += n_ * m_ * sizeof(float);
+            }
+            if (planes_ & kTrajectoryVelocity) {
+                bytes += 4 * n_ * m_ * sizeof(float);
+            }
+            in_.seekg(static_cast<std::streamoff>(bytes), std::ios::cur);
+            return in_.tellg() <= end_;
+        }
+        if (!SkipRuns(1)) {
+            return false;
+        }
+        if ((planes_ & kTrajectoryPressure) && !SkipRuns(sizeof(float))) {
+            return false;
+        }
+        if ((planes_ & kTrajectoryVelocity) && !SkipRuns(sizeof(float))) {
+            return false;
+        }
+        return in_.tellg() <= end_;
+    }
+
+    bool SkipRuns(size_t value_size) {
+        uint64_t runs;
+        if (!ReadVarint(in_, runs)) {
+            return false;
+        }
+        for (uint64_t r = 0; r < runs; ++r) {
+            uint64_t gap, len;
+            if (!ReadVarint(in_, gap) || !ReadVarint(in_, len)) {
+                return false;
+            }
+            in_.seekg(static_cast<std::streamoff>(len * value_size), std::ios::cur);
+        }
+        return true;
+    }
+
+    bool Apply(const Record& record, Frame& frame) {
+        in_.clear();
+        in_.seekg(record.offset);
+        in_.get();
+        uint64_t tick;
+        ReadVarint(in_, tick);
+        if (record.keyframe) {
+            return ReadWhole(frame.cells) && ReadWhole(frame.pressure) && ReadWhole(frame.velocity);
+        }
+        return ApplyRuns(frame.cells) && ((planes_ & kTrajectoryPressure) == 0 || ApplyRuns(frame.pressure))
+               && ((planes_ & kTrajectoryVelocity) == 0 || ApplyRuns(frame.velocity));
+    }
+
+    template <typename T>
+    bool ReadWhole(std::vector<T>& values) {
+        in_.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+        return static_cast<bool>(in_);
+    }
+
+    template <typename T>
+    bool ApplyRuns(std::vector<T>& values) {
+        uint64_t runs;
+        if (!ReadVarint(in_, runs)) {
+            return false;
+        }
+        size_t end = 0;
+        for (uint64_t r = 0; r < runs; ++r) {
+            uint64_t gap, len;
+            if (!ReadVarint(in_, gap) || !ReadVarint(in_, len) || end + gap + len > values.size()) {
+                return false;
+            }
+            in_.read(reinterpret_cast<char*>(values.data() + end + gap), static_cast<std::streamsize>(len * sizeof(T)));
+            end += gap + len;
+        }
+        return static_cast<bool>(in_);
+    }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads kept for the whole life of their owner, so a parallel phase costs one wake-up per
+// worker instead of creating and joining threads every tick. Run() hands the same job to every
+// worker and runs it on the calling thread too, then waits until all of them are done.
+class WorkerPool {
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable start_, done_;
+    std::function<void()> job_;
+    size_t generation_ = 0;
+    size_t running_ = 0;
+    bool stop_ = false;
+
+public:
+    // threads counts the caller, so a pool of n starts n - 1 workers.
+    explicit WorkerPool(size_t threads) {
+        for (size_t i = 1; i < threads; ++i) {
+            threads_.emplace_back([this] { Loop(); });
+        }
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard lock(mutex_);
+            stop_ = true;
+        }
+        start_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    size_t Size() const {
+        return threads_.size() + 1;
+    }
+
+    void Run(std::function<void()> job) {
+        {
+            std::lock_guard lock(mutex_);
+            job_ = std::move(job);
+            running_ = threads_.size();
+            ++generation_;
+        }
+        start_.notify_all();
+        job_();
+        std::unique_lock lock(mutex_);
+        done_.wait(lock, [this] { return running_ == 0; });
+    }
+
+private:
+    void Loop() {
+        size_t seen = 0;
+        std::unique_lock lock(mutex_);
+        while (true) {
+            start_.wait(lock, [&] { return stop_ || generation_ != seen; });
+            if (stop_) {
+                return;
+            }
+            seen = generation_;
+            lock.unlock();
+            job_();
+            lock.lock();
+            if (--running_ == 0) {
+                done_.notify_one();
+            }
+        }
+    }
+};
@@ -0,0 +1,103 @@
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include "Fixed.hpp"
+#include "FastFixed.hpp"
+#include "Simulator.hpp"
+#include "Input.hpp"
+
+// fluid_bench_flow [input] [ticks] [stripe rows]
+// Runs the same input without the striped pre-pass of the flow phase, then with it on 1, 2, 4, ..., 64
+// threads, and reports wall time, process CPU time and the flow sweeps of each run. The stripe layout
+// is the same for every thread count, so all runs with the pre-pass must end in the same state;
+// the bench fails if one does not. Only stripes, N / stripe rows of them, are shared out, so more
+// threads than stripes cannot help.
+
+using Fluid = Simulator<float, Fixed<32, 16>, FastFixed<32, 15>>;
+
+struct Sample {
+    double wall, cpu;
+    size_t stripe_sweeps, full_sweeps;
+    std::string state;
+};
+
+Sample Measure(const Input& input, size_t ticks, size_t stripe_rows, size_t threads) {
+    SimulatorOptions options;
+    options.flow_stripe_rows = stripe_rows;
+    options.flow_threads = threads;
+    std::string error;
+    auto fluid = Fluid::Create(input.field, input.rho_air, input.rho_fluid, input.g, error, options);
+
+    auto wall_start = std::chrono::steady_clock::now();
+    std::clock_t cpu_start = std::clock();
+    fluid->Step(ticks);
+    std::clock_t cpu_end = std::clock();
+    auto wall_end = std::chrono::steady_clock::now();
+
+    std::ostringstream state;
+    fluid->Save(state);
+    return {std::chrono::duration<double>(wall_end - wall_start).count(),
+            static_cast<double>(cpu_end - cpu_start) / CLOCKS_PER_SEC,
+            fluid->GetStats().stripe_sweeps, fluid->GetStats().full_sweeps, state.str()};
+}
+
+int main(int argc, char** argv) {
+    const char* input_path = argc > 1 ? argv[1] : "input.txt";
+    size_t ticks = 500, stripe_rows = 4;
+    auto parse = [](const char* arg, size_t& value) {
+        const char* end = arg + std::strlen(arg);
+        auto [ptr, ec] = std::from_chars(arg, end, value);
+        return ec == std::errc() && ptr == end && ptr != arg;
+    };
+    if (argc > 4 || (argc >= 3 && !parse(argv[2], ticks)) || (argc == 4 && (!parse(argv[3], stripe_rows) || stripe_rows < 2))) {
+        std::cerr << "usage: " << argv[0] << " [input] [ticks] [stripe rows >= 2]\n";
+        return 1;
+    }
+
+    std::ifstream fin(input_path);
+    Input input;
+    if (!fin || !ReadInput(fin, input)) {
+        std::cerr << "error during reading " << input_path << "\n";
+        return 1;
+    }
+    SimulatorOptions options;
+    options.flow_stripe_rows = stripe_rows;
+    std::string error = Fluid::Validate(input.field, input.rho_air, input.rho_fluid, options);
+    if (!error.empty()) {
+        std::cerr << "invalid input: " << error << "\n";
+        return 1;
+    }
+
+    size_t rows = input.field.size();
+    std::cout << rows << "x" << input.field.front().size() - 1 << ", " << ticks << " ticks, " << rows / stripe_rows
+              << " stripes of " << stripe_rows << " rows, " << std::thread::hardware_concurrency() << " hardware threads\n"
+              << "threads   wall s    cpu s  stripe sweeps  full sweeps  same state\n";
+    auto print = [](const std::string& threads, const Sample& sample, const std::string& same) {
+        std::cout << std::setw(7) << threads << std::fixed << std::setprecision(3) << std::setw(9) << sample.wall
+                  << std::setw(9) << sample.cpu << std::setw(15) << sample.stripe_sweeps << std::setw(13)
+                  << sample.full_sweeps << std::setw(12) << same << std::endl;
+    };
+    print("no pass", Measure(input, ticks, 0, 1), "-");
+
+    Sample first;
+    bool same = true;
+    for (size_t threads = 1; threads <= 64; threads *= 2) {
+        Sample sample = Measure(input, ticks, stripe_rows, threads);
+        if (threads == 1) {
+            first = sample;
+        }
+        same &= sample.state == first.state;
+        print(std::to_string(threads), sample, sample.state == first.state ? "yes" : "no");
+    }
+    if (!same) {
+        std::cerr << "the state depends on the number of threads\n";
+        return 1;
+    }
+}
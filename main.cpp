@@ -3,38 +3,89 @@
 #include "Fixed.hpp"
 #include "FastFixed.hpp"
 #include "Simulator.hpp"
+#include "Input.hpp"
+#include "Trajectory.hpp"
+#include "SharedFrames.hpp"
 
-template <typename type_p, typename type_v, typename type_vf, size_t Rows = mx_size, size_t Columns = mx_size>
-class Simulator;
+constexpr size_t t = 5'000;
+constexpr bool compact_state = false;
+// Striped pre-pass of the flow phase, see bench/flow_scaling.cpp. 0 rows keeps the baseline output.
+constexpr size_t flow_stripe_rows = 0;
+constexpr size_t flow_threads = 1;
+constexpr bool print_ticks = false;
+constexpr bool write_trajectory = true;
+constexpr size_t keyframe_rate = 100;
+constexpr const char* trajectory_path = "trajectory.bin";
+// TrajectoryPlanes to record along with the field, 0 keeps the trajectory at format version 2.
+constexpr uint32_t trajectory_planes = 0;
+constexpr bool publish_frames = false;
+constexpr const char* frames_shm_name = "/fluid_frames";
+constexpr size_t frames_slots = 8;
+constexpr uint32_t frames_planes = kFieldPlane;
 
-int main() {
+int main(int argc, char** argv) {
+    const char* input_path = argc > 1 ? argv[1] : "input.txt";
     std::ifstream fin;
-    fin.open("input.txt", std::ios_base::in);
+    fin.open(input_path, std::ios_base::in);
     if (!fin) {
         std::cerr << "error during file opening\n";
         return 1;
     }
 
-    int n, m;
-    fin >> n >> m;
-    float rho_air, g;
-    int rho_fluid;
-    std::vector field(n, std::vector<char>(m + 1));
-    fin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-    std::string s;
-    for (int i = 0; i < n; ++i) {
-        getline(fin, s);
-        for (int j = 0; j < m + 1; ++j) {
-            field[i][j] = s[j];
-            if (j == m) {
-                field[i][j] = '\0';
-            }
-        }
+    Input input;
+    if (!ReadInput(fin, input)) {
+        std::cerr << "error during reading " << input_path << "\n";
+        return 1;
     }
-
-    fin >> rho_air >> rho_fluid >> g;
     fin.close();
 
-    Simulator<float, Fixed<32, 16>, FastFixed<32, 15>, 36, 84> fluid(field, rho_air, rho_fluid, g);
-    fluid.Run();
-}
\ No newline at end of file
+    using Fluid = Simulator<float, Fixed<32, 16>, FastFixed<32, 15>, 36, 84, compact_state>;
+    SimulatorOptions options;
+    options.flow_stripe_rows = flow_stripe_rows;
+    options.flow_threads = flow_threads;
+    std::string error;
+    auto fluid = Fluid::Create(input.field, input.rho_air, input.rho_fluid, input.g, error, options);
+    if (!fluid) {
+        std::cerr << "invalid input: " << error << "\n";
+        return 1;
+    }
+    std::cout << "Static version constructor called with sizes: " << fluid->RowCount() << " " << fluid->ColumnCount() << "\n";
+    Fluid::PrintMemoryReport(std::cout);
+
+    TrajectoryWriter trajectory;
+    if (write_trajectory && !trajectory.Open(trajectory_path, fluid->RowCount(), fluid->ColumnCount(), keyframe_rate, trajectory_planes)) {
+        std::cerr << "Error during opening trajectory file\n";
+        return 1;
+    }
+    FramePublisher frames;
+    if (publish_frames && !frames.Open(frames_shm_name, fluid->RowCount(), fluid->ColumnCount(), frames_slots, frames_planes)) {
+        std::cerr << "Error during opening shared memory " << frames_shm_name << "\n";
+        return 1;
+    }
+
+    fluid->on_tick = [&](const Fluid& sim, size_t tick, bool moved) {
+        if (print_ticks && moved) {
+            std::cout << "Tick " << tick << ":\n";
+            sim.PrintField(std::cout);
+        }
+        if (write_trajectory) {
+            trajectory.Write(tick, sim.GetField(), sim.Pressure(), sim.VelocityPlane());
+        }
+        if (publish_frames) {
+            frames.Publish(tick, sim.GetField(), sim.Pressure(), sim.VelocityPlane());
+        }
+        return true;
+    };
+    fluid->on_checkpoint = [&](const Fluid& sim, size_t) {
+        if (write_trajectory) {
+            trajectory.Flush();
+        }
+        if (!sim.SaveToFile("dump.txt")) {
+            std::cerr << "Error during opening file\n";
+            return false;
+        }
+        return true;
+    };
+
+    return fluid->Step(t) ? 0 : 1;
+}
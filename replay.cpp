@@ -0,0 +1,88 @@
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "Trajectory.hpp"
+
+// fluid_replay <trajectory>                        prints a summary of the recorded ticks
+// fluid_replay <trajectory> <tick>                 prints the field after that tick
+// fluid_replay <trajectory> <from> <to>            prints every tick in [from, to] in the simulator's "Tick i:" format
+// fluid_replay <trajectory> --export <tick> <out>  writes the state after that tick to out as raw binary:
+//                                                  N*M chars, then the recorded planes as floats in host byte
+//                                                  order, N*M of pressure and 4*N*M of velocity
+
+void PrintField(size_t tick, const std::vector<char>& cells, size_t n, size_t m) {
+    std::cout << "Tick " << tick << ":\n";
+    for (size_t x = 0; x < n; ++x) {
+        std::cout.write(cells.data() + x * m, static_cast<std::streamsize>(m));
+        std::cout << "\n";
+    }
+}
+
+bool ParseTick(const char* arg, size_t& tick) {
+    const char* end = arg + std::strlen(arg);
+    auto [ptr, ec] = std::from_chars(arg, end, tick);
+    return ec == std::errc() && ptr == end && ptr != arg;
+}
+
+bool Export(const TrajectoryReader::Frame& frame, const char* path) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(frame.cells.data(), static_cast<std::streamsize>(frame.cells.size()));
+    out.write(reinterpret_cast<const char*>(frame.pressure.data()), static_cast<std::streamsize>(frame.pressure.size() * sizeof(float)));
+    out.write(reinterpret_cast<const char*>(frame.velocity.data()), static_cast<std::streamsize>(frame.velocity.size() * sizeof(float)));
+    return static_cast<bool>(out);
+}
+
+int main(int argc, char** argv) {
+    size_t from = 0, to = 0;
+    bool export_mode = argc == 5 && std::strcmp(argv[2], "--export") == 0;
+    if (export_mode ? !ParseTick(argv[3], from)
+                    : argc < 2 || argc > 4 || (argc >= 3 && !ParseTick(argv[2], from)) || (argc == 4 && !ParseTick(argv[3], to))
+                          || (argc == 4 && to < from)) {
+        std::cerr << "usage: " << argv[0] << " <trajectory> [tick | from to | --export tick out]\n";
+        return 1;
+    }
+
+    TrajectoryReader reader;
+    if (!reader.Open(argv[1])) {
+        std::cerr << "error during reading trajectory " << argv[1] << "\n";
+        return 1;
+    }
+
+    const auto& records = reader.Records();
+    if (argc == 2) {
+        size_t keyframes = std::ranges::count_if(records, &TrajectoryReader::Record::keyframe);
+        std::cout << reader.Rows() << " " << reader.Columns() << "\n"
+                  << "ticks " << records.front().tick << ".." << records.back().tick << "\n"
+                  << "records " << records.size() << " (keyframes " << keyframes << ", every " << reader.KeyframeRate() << " ticks)\n"
+                  << "planes field" << (reader.Planes() & kTrajectoryPressure ? " pressure" : "")
+                  << (reader.Planes() & kTrajectoryVelocity ? " velocity" : "") << "\n";
+        return 0;
+    }
+
+    if (argc == 3 || export_mode) {
+        to = from;
+    }
+    TrajectoryReader::Frame frame;
+    if (!reader.Seek(from, frame)) {
+        std::cerr << "tick " << from << " is not in the trajectory\n";
+        return 1;
+    }
+    if (export_mode) {
+        if (!Export(frame, argv[4])) {
+            std::cerr << "error during writing " << argv[4] << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    PrintField(from, frame.cells, reader.Rows(), reader.Columns());
+    // Later ticks of the range are reached by applying one record after another, not by seeking again.
+    for (size_t tick = from; tick < to;) {
+        if (!reader.Next(tick, frame)) {
+            std::cerr << "tick " << tick + 1 << " is not in the trajectory\n";
+            return 1;
+        }
+        PrintField(tick, frame.cells, reader.Rows(), reader.Columns());
+    }
+}
@@ -0,0 +1,70 @@
+#undef NDEBUG
+#include <array>
+#include <cassert>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Simulator.hpp"
+
+// Runs adaptive blocks on a box whose air and still basin freeze at once, while a block of fluid
+// falls from the top onto the basin. Every tick must keep the number of each kind of cell, some
+// blocks must be frozen along the way, and the falling fluid must thaw some of them.
+
+constexpr size_t rows = 48, cols = 96, ticks = 8, block_size = 4;
+
+using Fluid = Simulator<float, float, float>;
+
+std::vector<std::vector<char>> MakeGrid() {
+    std::vector<std::vector<char>> grid(rows, std::vector<char>(cols + 1, ' '));
+    for (size_t x = 0; x < rows; ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            bool border = x == 0 || x == rows - 1 || y == 0 || y == cols - 1;
+            if (border) {
+                grid[x][y] = '#';
+            } else if ((x < 12 && y > 36 && y < 60) || x > rows - 12) {
+                grid[x][y] = '.';
+            }
+        }
+        grid[x][cols] = '\0';
+    }
+    return grid;
+}
+
+std::array<size_t, 256> CountCells(const Fluid& sim) {
+    std::array<size_t, 256> counts{};
+    for (size_t x = 0; x < sim.RowCount(); ++x) {
+        for (size_t y = 0; y < sim.ColumnCount(); ++y) {
+            ++counts[static_cast<unsigned char>(sim.GetField()[x][y])];
+        }
+    }
+    return counts;
+}
+
+int main() {
+    SimulatorOptions options;
+    options.adaptive_blocks = true;
+    options.block_size = block_size;
+    options.coarsen_rate = 1;
+    std::string error;
+    auto fluid = Fluid::Create(MakeGrid(), 0.01, 1000, 0.1, error, options);
+    assert(fluid);
+
+    auto initial = CountCells(*fluid);
+    bool froze = false;
+    fluid->on_tick = [&initial, &froze](const Fluid& sim, size_t, bool) {
+        froze = froze || sim.GetStats().frozen_blocks > 0;
+        return CountCells(sim) == initial;
+    };
+    if (!fluid->Step(ticks)) {
+        std::cerr << "cells were lost\n";
+        return 1;
+    }
+    if (!froze || fluid->GetStats().thawed_blocks == 0) {
+        std::cerr << "frozen blocks: " << fluid->GetStats().frozen_blocks
+                  << ", thawed: " << fluid->GetStats().thawed_blocks << "; expected both\n";
+        return 1;
+    }
+    std::cout << "adaptive blocks: " << rows << "x" << cols << ", " << ticks << " ticks, "
+              << fluid->GetStats().thawed_blocks << " blocks thawed\n";
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <pthread.h>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Simulator.hpp"
+
+// Runs a large dynamic-size grid on a thread whose stack is far too small for the recursive
+// PropagateMove / PropagateStop, which overflow 1 MiB on this grid, and compares every tick's field
+// against a digest recorded with the recursive implementation (commit "Add delta-encoded binary
+// trajectory") on a large stack. The float results, and so the digest, need FMA contraction off.
+
+constexpr size_t rows = 200, cols = 400, ticks = 4;
+constexpr size_t stack_size = 64 * 1024;
+constexpr uint64_t reference_digest = 0x163399309a94c80d;
+
+using Fluid = Simulator<float, float, float>;
+
+// Walls all around, shelves with gaps across the box, a block of fluid in the upper left
+// and a basin at the bottom. The rows end in the '\0' column Input.hpp adds.
+std::vector<std::vector<char>> MakeGrid() {
+    std::vector<std::vector<char>> grid(rows, std::vector<char>(cols + 1, ' '));
+    for (size_t x = 0; x < rows; ++x) {
+        for (size_t y = 0; y < cols; ++y) {
+            bool border = x == 0 || x == rows - 1 || y == 0 || y == cols - 1;
+            bool shelf = x % 40 == 20 && y % 64 > 8;
+            if (border || shelf) {
+                grid[x][y] = '#';
+            } else if ((x < 60 && y < cols / 2) || x > rows - 24) {
+                grid[x][y] = '.';
+            }
+        }
+        grid[x][cols] = '\0';
+    }
+    return grid;
+}
+
+struct Result {
+    std::string error;
+    uint64_t digest = 14695981039346656037ull;
+};
+
+void* Run(void* arg) {
+    auto& result = *static_cast<Result*>(arg);
+    auto fluid = Fluid::Create(MakeGrid(), 0.01, 1000, 0.1, result.error);
+    if (!fluid) {
+        return nullptr;
+    }
+    // FNV-1a over the field after every tick.
+    fluid->on_tick = [&result](const Fluid& sim, size_t, bool) {
+        for (size_t x = 0; x < sim.RowCount(); ++x) {
+            for (size_t y = 0; y < sim.ColumnCount(); ++y) {
+                result.digest = (result.digest ^ static_cast<uint8_t>(sim.GetField()[x][y])) * 1099511628211ull;
+            }
+        }
+        return true;
+    };
+    fluid->Step(ticks);
+    return nullptr;
+}
+
+int main() {
+    Result result;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_t thread;
+    if (pthread_attr_setstacksize(&attr, stack_size) != 0 || pthread_create(&thread, &attr, Run, &result) != 0) {
+        std::cerr << "error during starting the simulation thread\n";
+        return 1;
+    }
+    pthread_join(thread, nullptr);
+    pthread_attr_destroy(&attr);
+
+    if (!result.error.empty()) {
+        std::cerr << "invalid grid: " << result.error << "\n";
+        return 1;
+    }
+    if (result.digest != reference_digest) {
+        std::cerr << "digest " << std::hex << result.digest << " differs from the reference " << reference_digest << "\n";
+        return 1;
+    }
+    std::cout << "stress: " << rows << "x" << cols << ", " << ticks << " ticks on a " << stack_size / 1024 << " KiB stack\n";
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SharedFrames.hpp"
+
+// fluid_viewer [shm name] [--once]
+// Follows the frames published by the simulator and prints each new one in the "Tick i:" format.
+// Frames that were overwritten before they could be read are skipped, the simulator never waits for us.
+
+class FrameReader {
+    const void* data_ = nullptr;
+    size_t size_ = 0;
+    const SharedFramesHeader* header_ = nullptr;
+
+public:
+    ~FrameReader() {
+        if (data_ != nullptr) {
+            munmap(const_cast<void*>(data_), size_);
+        }
+    }
+
+    bool Open(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st{};
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SharedFramesHeader)) {
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = data;
+        size_ = st.st_size;
+        header_ = static_cast<const SharedFramesHeader*>(data);
+        // Read() indexes slots by seq % slots and copies rows * cols chars out of them, so the header
+        // has to describe slots that exist and are large enough for the planes it claims.
+        return std::memcmp(header_->magic, frames_magic, sizeof(frames_magic)) == 0 && header_->version == frames_version
+               && header_->slots != 0 && header_->slot_size >= FrameSlotSize(header_->rows, header_->cols, header_->planes)
+               && header_->slot_size <= (size_ - sizeof(SharedFramesHeader)) / header_->slots;
+    }
+
+    size_t Rows() const {
+        return header_->rows;
+    }
+
+    size_t Columns() const {
+        return header_->cols;
+    }
+
+    uint64_t Latest() const {
+        return header_->latest.load(std::memory_order_acquire);
+    }
+
+    // Copies frame `seq` out of the ring. Fails if the simulator has already started overwriting its slot.
+    bool Read(uint64_t seq, size_t& tick, std::vector<char>& cells) const {
+        auto* slot = reinterpret_cast<const FrameSlotHeader*>(static_cast<const char*>(data_) + sizeof(SharedFramesHeader)
+                                                              + (seq % header_->slots) * header_->slot_size);
+        if (slot->seq.load(std::memory_order_acquire) != seq) {
+            return false;
+        }
+        tick = slot->tick;
+        const char* field = reinterpret_cast<const char*>(slot + 1);
+        cells.assign(field, field + Rows() * Columns());
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot->seq.load(std::memory_order_relaxed) == seq;
+    }
+};
+
+int main(int argc, char** argv) {
+    std::string name = "/fluid_frames";
+    bool once = false;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--once") {
+            once = true;
+        } else {
+            name = arg;
+        }
+    }
+
+    FrameReader reader;
+    if (!reader.Open(name)) {
+        std::cerr << "error during opening shared memory " << name << "\n";
+        return 1;
+    }
+
+    uint64_t shown = 0;
+    size_t tick;
+    std::vector<char> cells;
+    while (true) {
+        uint64_t latest = reader.Latest();
+        if (latest == shown || !reader.Read(latest, tick, cells)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        shown = latest;
+        std::cout << "Tick " << tick << ":\n";
+        for (size_t x = 0; x < reader.Rows(); ++x) {
+            std::cout.write(cells.data() + x * reader.Columns(), static_cast<std::streamsize>(reader.Columns()));
+            std::cout << "\n";
+        }
+        std::cout.flush();
+        if (once) {
+            return 0;
+        }
+    }
+}